@@ -8,19 +8,30 @@
 #define ROOM_CELLS_LENGTH ROOM_WIDTH * ROOM_HEIGHT
 #define WORLD_WIDTH 10
 #define WORLD_HEIGHT 5
+#define WORLD_ROOMS_LENGTH (WORLD_WIDTH * WORLD_HEIGHT)
 #define GAME_AREA_WIDTH TILE_WIDTH * ROOM_WIDTH
 #define GAME_AREA_HEIGHT TILE_HEIGHT * ROOM_HEIGHT
 #define PIXEL_SIZE 3
 
+#define PLAYER_WIDTH 14
+#define PLAYER_HEIGHT 26
+#define PLAYER_RUN_SPEED 2
+#define PLAYER_JUMP_SPEED -4.0f
+#define PLAYER_GRAVITY 0.2f
+
 #define TILE_EMPTY 0
 #define TILE_SAVE 1
 #define TILE_WALL 2
 
 #define FILENAME_WORLD "data/world.bin"
+#define FILENAME_WORLD_JOURNAL "data/world.bin.journal"
+#define FILENAME_WORLD_JOURNAL_TEMP "data/world.bin.journal.tmp"
 #define FILENAME_SAVE_1 "save1.bin"
 #define FILENAME_SAVE_2 "save2.bin"
 #define FILENAME_SAVE_3 "save3.bin"
+#define FILENAME_LATENCY_LOG "latency.log"
 
 #define NUM_SAVES 3
+#define AUTOSAVE_INTERVAL 10.0f
 
 #endif
\ No newline at end of file
@@ -44,46 +44,16 @@ const bool CheckCollisionGridTilePoint(const Grid *grid, int tile, int x, int y)
 
 const bool CheckCollisionGridTileRec(const Grid *grid, int tile, Rectangle rect)
 {
-    if(CheckCollisionGridTilePoint(grid, tile, rect.x, rect.y))                                       return true;
-    if(CheckCollisionGridTilePoint(grid, tile, rect.x + rect.width - 1, rect.y))                      return true;
-    if(CheckCollisionGridTilePoint(grid, tile, rect.x + rect.width - 1, rect.y + rect.height - 1))    return true;
-    if(CheckCollisionGridTilePoint(grid, tile, rect.x, rect.y + rect.height - 1))                     return true;
-    return false;
+    return CheckCollisionGridTileBox(grid, tile, rect.x, rect.y, rect.width, rect.height);
 }
 
-void RoomSave(const Grid *grid)
+const bool CheckCollisionGridTileBox(const Grid *grid, int tile, int x, int y, int width, int height)
 {
-    int expectedDataSize = ROOM_WIDTH * ROOM_HEIGHT * WORLD_WIDTH * WORLD_HEIGHT * sizeof(int);
-    int fileDataSize;
-    unsigned char *data = 0;
-    
-    if(!FileExists(FILENAME_WORLD))
-    {
-        int default_data[expectedDataSize];
-        for(int i = 0; i < expectedDataSize; i++) { default_data[i] = TILE_WALL;}
-        SaveFileData(FILENAME_WORLD, &default_data, expectedDataSize);
-        //SaveFileData(FILENAME_WORLD, (void*)grid->cells, sizeof(grid->cells));
-        
-    }
-    
-    data = LoadFileData(FILENAME_WORLD, &fileDataSize);
-
-    if(fileDataSize != expectedDataSize)
-    {
-        UnloadFileData(data);
-        int default_data[expectedDataSize];
-        for(int i = 0; i < expectedDataSize; i++) { default_data[i] = TILE_WALL;}
-        SaveFileData(FILENAME_WORLD, &default_data, expectedDataSize);
-        return;
-    }
-    int offset = (grid->y * WORLD_WIDTH + grid->x) * (ROOM_WIDTH * ROOM_HEIGHT) * sizeof(int);
-    for(int i = 0; i < ROOM_WIDTH * ROOM_HEIGHT; i++)
-    {
-        unsigned char *ptr = data + offset + i * sizeof(int);
-        *ptr = grid->cells[i];
-    }
-    SaveFileData(FILENAME_WORLD, data, expectedDataSize);
-    UnloadFileData(data);
+    if(CheckCollisionGridTilePoint(grid, tile, x, y))                              return true;
+    if(CheckCollisionGridTilePoint(grid, tile, x + width - 1, y))                  return true;
+    if(CheckCollisionGridTilePoint(grid, tile, x + width - 1, y + height - 1))     return true;
+    if(CheckCollisionGridTilePoint(grid, tile, x, y + height - 1))                 return true;
+    return false;
 }
 
 void RoomLoad(Grid *room)
@@ -12,7 +12,6 @@ typedef struct Grid
     int width;
 } Grid;
 
-void RoomSave(const Grid *grid);
 void RoomLoad(Grid *room);
 const int RoomGetWidth();
 const int RoomGetHeight();
@@ -23,5 +22,6 @@ const int GridGet(const Grid *grid, int x, int y);
 const int GridGetHeight(Grid grid);
 const bool CheckCollisionGridTilePoint(const Grid *grid, int tile, int x, int y);
 const bool CheckCollisionGridTileRec(const Grid *grid, int tile, Rectangle rect);
+const bool CheckCollisionGridTileBox(const Grid *grid, int tile, int x, int y, int width, int height);
 
 #endif
\ No newline at end of file
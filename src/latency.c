@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include <math.h>
+#include "latency.h"
+#include "game_params.h"
+
+static int CompareFloat(const void *a, const void *b);
+
+void LatencyInit(LatencyStats *stats, LatencyMode mode)
+{
+    stats->frameControl = true;
+    stats->enabled = false;
+    stats->log = NULL;
+    stats->sampleHead = stats->sampleCount = 0;
+    stats->frame = 0;
+    stats->sampleTime = stats->previousSampleTime = GetTime();
+    stats->frameStart = stats->swapTime = stats->sampleTime;
+    stats->workTime = 0.0f;
+    stats->frameInterval = 1.0f / LATENCY_TARGET_FPS;
+    LatencySetMode(stats, mode);
+}
+
+void LatencyUnload(LatencyStats *stats)
+{
+    LatencySetEnabled(stats, false);
+}
+
+void LatencySetMode(LatencyStats *stats, LatencyMode mode)
+{
+    if(!stats->frameControl) return;
+    stats->mode = mode;
+    stats->sampleHead = stats->sampleCount = 0;
+
+    // The game steps once per frame, so off the limiter its speed follows the display.
+    // This is why modes can only be changed in profiler builds.
+    if(mode == LATENCY_MODE_LATE || mode == LATENCY_MODE_VSYNC) SetWindowState(FLAG_VSYNC_HINT);
+    else ClearWindowState(FLAG_VSYNC_HINT);
+}
+
+// Recording starts a new log so runs in different modes can be compared
+void LatencySetEnabled(LatencyStats *stats, bool enabled)
+{
+    if(enabled == stats->enabled) return;
+    if(enabled && !stats->frameControl) return;
+    stats->enabled = enabled;
+    stats->sampleHead = stats->sampleCount = 0;
+
+    if(enabled)
+    {
+        stats->log = fopen(FILENAME_LATENCY_LOG, "w");
+        if(stats->log) fprintf(stats->log, "frame,mode,latency_ms,window_ms\n");
+        return;
+    }
+    if(stats->log) fclose(stats->log);
+    stats->log = NULL;
+}
+
+// Paces the frame for the current mode, then polls input. Call before ProcessInputs.
+void LatencyBeginFrame(LatencyStats *stats)
+{
+    if(!stats->frameControl) return;
+    double now = GetTime();
+    double target = now;
+    if(stats->mode == LATENCY_MODE_LIMITER)
+    {
+        target = stats->frameStart + 1.0 / LATENCY_TARGET_FPS;
+        if(target < now) target = now;  // Fell behind, do not try to catch up
+        stats->frameStart = target;
+    }
+    else if(stats->mode == LATENCY_MODE_LATE)
+    {
+        // The swap returned on a vblank, sleep through the part of the next refresh we do not need
+        int refreshRate = GetMonitorRefreshRate(GetCurrentMonitor());
+        if(refreshRate <= 0) refreshRate = LATENCY_TARGET_FPS;
+        target = stats->swapTime + 1.0 / refreshRate - stats->workTime - LATENCY_LATE_MARGIN;
+    }
+    if(target > now) WaitTime(target - now);
+
+    PollInputEvents();
+    stats->previousSampleTime = stats->sampleTime;
+    stats->sampleTime = GetTime();
+    stats->frame++;
+
+    // raylib does not timestamp events, any key pressed since the previous poll counts
+    stats->inputThisFrame = IsMouseButtonPressed(MOUSE_BUTTON_LEFT);
+    while(GetKeyPressed() != 0) stats->inputThisFrame = true;
+}
+
+// Swaps the buffers and records the frame. Call after EndDrawing, which only flushes the batch.
+void LatencyEndFrame(LatencyStats *stats)
+{
+    if(!stats->frameControl) return;
+
+    // Only EndDrawing's own timing sets the frame time, it stays 0 under custom frame control.
+    // A stock raylib already swapped and polled, hand pacing back to it.
+    if(stats->frame == 1 && GetFrameTime() > 0.0f)
+    {
+        TraceLog(LOG_WARNING, "LATENCY: raylib was not built with SUPPORT_CUSTOM_FRAME_CONTROL, profiler disabled");
+        stats->frameControl = false;
+        LatencySetEnabled(stats, false);
+        ClearWindowState(FLAG_VSYNC_HINT);
+        SetTargetFPS(LATENCY_TARGET_FPS);
+        return;
+    }
+
+    double recorded = GetTime();
+    SwapScreenBuffer();
+    double swapped = GetTime();
+
+    // Late sampling budget: follow spikes at once, relax slowly
+    float work = recorded - stats->sampleTime;
+    if(work > stats->workTime) stats->workTime = work;
+    else stats->workTime += (work - stats->workTime) * 0.05f;
+    stats->frameInterval += ((swapped - stats->swapTime) - stats->frameInterval) * 0.1f;
+    stats->swapTime = swapped;
+
+    if(!stats->enabled || !stats->inputThisFrame) return;
+
+    LatencySample sample = {(swapped - stats->sampleTime) * 1000.0, (swapped - stats->previousSampleTime) * 1000.0};
+    stats->samples[(stats->sampleHead + stats->sampleCount) % LATENCY_SAMPLES] = sample;
+    if(stats->sampleCount < LATENCY_SAMPLES) stats->sampleCount++;
+    else stats->sampleHead = (stats->sampleHead + 1) % LATENCY_SAMPLES;
+
+    if(stats->log) fprintf(stats->log, "%u,%s,%.3f,%.3f\n", stats->frame, LatencyModeName(stats->mode), sample.latency, sample.window);
+}
+
+void LatencyDrawOverlay(const LatencyStats *stats, int x, int y)
+{
+    float latencies[LATENCY_SAMPLES];
+    float windowSum = 0.0f;
+    float latencySum = 0.0f;
+    for(int i = 0; i < stats->sampleCount; i++)
+    {
+        latencies[i] = stats->samples[i].latency;
+        latencySum += stats->samples[i].latency;
+        windowSum += stats->samples[i].window;
+    }
+    qsort(latencies, stats->sampleCount, sizeof(float), CompareFloat);
+
+    DrawRectangle(x, y, 220, 72, Fade(BLACK, 0.6f));
+    // GetFPS relies on the timing done by EndDrawing, which custom frame control skips
+    DrawText(TextFormat("Mode: %s (F2)  FPS: %i", LatencyModeName(stats->mode), (int)roundf(1.0f / stats->frameInterval)), x + 6, y + 6, 10, WHITE);
+    if(stats->sampleCount == 0)
+    {
+        DrawText("Press keys to collect samples", x + 6, y + 22, 10, LIGHTGRAY);
+        return;
+    }
+    DrawText(TextFormat("Input to swap avg: %.2f ms", latencySum / stats->sampleCount), x + 6, y + 22, 10, WHITE);
+    DrawText(TextFormat("p50: %.2f  p99: %.2f  max: %.2f", latencies[stats->sampleCount / 2], latencies[stats->sampleCount * 99 / 100], latencies[stats->sampleCount - 1]), x + 6, y + 38, 10, WHITE);
+    DrawText(TextFormat("Worst case event age avg: %.2f ms", windowSum / stats->sampleCount), x + 6, y + 54, 10, WHITE);
+}
+
+const char *LatencyModeName(LatencyMode mode)
+{
+    if(mode == LATENCY_MODE_LATE) return "late";
+    if(mode == LATENCY_MODE_LIMITER) return "limiter";
+    if(mode == LATENCY_MODE_VSYNC) return "vsync";
+    return "uncapped";
+}
+
+static int CompareFloat(const void *a, const void *b)
+{
+    float fa = *(const float *)a;
+    float fb = *(const float *)b;
+    return (fa > fb) - (fa < fb);
+}
@@ -0,0 +1,57 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdio.h>
+#include "raylib.h"
+
+// Only used in LATENCY_PROFILER builds. raylib must be built with SUPPORT_CUSTOM_FRAME_CONTROL
+// so EndDrawing leaves swap, wait and polling to us, this is checked after the first frame.
+
+#define LATENCY_SAMPLES 240         // Input frames kept for the overlay statistics
+#define LATENCY_TARGET_FPS 60
+#define LATENCY_LATE_MARGIN 0.002   // Seconds kept between the end of the frame work and vblank
+
+typedef enum LatencyMode
+{
+    LATENCY_MODE_LATE = 0,          // Vsync, input sampled just in time to finish the frame before the next vblank
+    LATENCY_MODE_LIMITER,           // No vsync, paced at LATENCY_TARGET_FPS, waits then polls
+    LATENCY_MODE_VSYNC,             // Vsync, input polled as soon as the swap returns
+    LATENCY_MODE_UNCAPPED,          // No vsync, no pacing
+    LATENCY_MODE_COUNT
+} LatencyMode;
+
+typedef struct LatencySample
+{
+    float latency;                  // Input polled to buffer swap returned, in ms
+    float window;                   // Previous poll to buffer swap returned: worst case age of a key event, in ms
+} LatencySample;
+
+typedef struct LatencyStats
+{
+    LatencyMode mode;
+    bool frameControl;              // False when raylib paces frames itself, the profiler is then off
+    bool enabled;
+    bool inputThisFrame;
+    double sampleTime;
+    double previousSampleTime;
+    double frameStart;              // Limiter deadline base
+    double swapTime;                // When the last SwapScreenBuffer returned
+    float workTime;                 // Recent worst poll to swap time, without the swap itself
+    float frameInterval;            // Smoothed time between swaps
+    unsigned int frame;
+    LatencySample samples[LATENCY_SAMPLES];
+    int sampleHead;
+    int sampleCount;
+    FILE *log;
+} LatencyStats;
+
+void LatencyInit(LatencyStats *stats, LatencyMode mode);
+void LatencyUnload(LatencyStats *stats);
+void LatencySetMode(LatencyStats *stats, LatencyMode mode);
+void LatencySetEnabled(LatencyStats *stats, bool enabled);
+void LatencyBeginFrame(LatencyStats *stats);
+void LatencyEndFrame(LatencyStats *stats);
+void LatencyDrawOverlay(const LatencyStats *stats, int x, int y);
+const char *LatencyModeName(LatencyMode mode);
+
+#endif
\ No newline at end of file
@@ -1,9 +1,16 @@
 #include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <time.h>
 #include <math.h>
 #include "raylib.h"
 #include "utils.h"
 #include "game_params.h"
 #include "grid.h"
+#include "player.h"
+#include "worldmap.h"
+#include "worldsave.h"
+#include "latency.h"
 
 /* ---------------------------------- Type ---------------------------------- */
 typedef struct Int2
@@ -19,13 +26,6 @@ typedef struct Viewport
     Rectangle rectDest;
 } Viewport;
 
-typedef struct Player
-{
-    Rectangle rect;
-    Vector2 velocity;
-    Vector2 movementRemainder;
-} Player;
-
 typedef struct GameState
 {
     Grid currentRoom;
@@ -75,6 +75,8 @@ typedef struct CommandState
     int uiMoveVertical;
     unsigned char validate;
     unsigned char save;
+    unsigned char cycleLatencyMode;
+    unsigned char toggleProfiler;
 } CommandState;
 
 typedef struct EditorCommandState
@@ -106,10 +108,11 @@ static void Draw();
 static void DrawLoadScreen();
 static void DrawViewport();
 static void DrawEditorUI();
+static void DrawEditorStatus();
 static void DrawWorld();
+static void EditorSetTiles();
 
-static void PlayerMoveX(float amount);
-static void PlayerMoveY(float amount);
+static int RunPhysicsBenchmark(int frames);
 
 static void InitLoadScreen();
 static void InitGame(int saveSlot);
@@ -128,6 +131,9 @@ Camera2D screenSpaceCamera = { 0 }; // Smoothing camera
 GameState gameState = {0};
 EditorState editorState = {0};
 LoadScreenState loadScreenState = {0};
+WorldMap worldMap = {0};
+WorldSave worldSave = {0};
+LatencyStats latencyStats = {0};
 
 EditorCommandState editorCommands = {0};
 EditorCommandState editorCommandsEmpty = {0};
@@ -137,8 +143,15 @@ PersistentCommands persistentCommands = {0};
 
 GameScreen gameScreen = GAMESCREEN_TITLE;
 
-int main()
+int main(int argc, char *argv[])
 {
+    /* ---------------------------- Headless Replay ----------------------------- */
+    // Replays a scripted input sequence without a window and prints the state hash
+    if(argc >= 2 && strcmp(argv[1], "--physics-bench") == 0)
+    {
+        return RunPhysicsBenchmark(argc >= 3 ? atoi(argv[2]) : 100000);
+    }
+
     /* ----------------------------- Initialization ----------------------------- */
     int windowWidth = TILE_WIDTH * ROOM_WIDTH * PIXEL_SIZE;
     int windowHeight = 0;
@@ -159,29 +172,44 @@ int main()
     tex_selector = LoadTexture("data/texture_ui_selector.png");
 
     /* ----------------------------- Init Game State ---------------------------- */
+    WorldSaveInit(&worldSave);
     gameState.currentRoom.width = ROOM_WIDTH;
-    RoomLoad(&gameState.currentRoom);
-    gameState.player.rect.width = 14;
-    gameState.player.rect.height = 26;
-    gameState.player.velocity.x = gameState.player.velocity.y = 0.0f;
+    WorldSaveLoadRoom(&worldSave, &gameState.currentRoom);
+    PlayerInit(&gameState.player);
     gameState.currentRoom.x = gameState.currentRoom.y = 0;
     persistentCommands.jump.lifetime = 5;
 
     /* ---------------------------- Init Editor State --------------------------- */
     editorState.selector = tex_selector;
     editorState.active = false;
+    WorldMapInit(&worldMap, "data/texture_tileset_01.png");
 
     /* -------------------------------- Main Loop ------------------------------- */
+#ifdef LATENCY_PROFILER
+    LatencyInit(&latencyStats, LATENCY_MODE_LIMITER);
+#else
     SetTargetFPS(60);
+#endif
 
     while (!WindowShouldClose())    // Detect window close button or ESC key
     {
+#ifdef LATENCY_PROFILER
+        LatencyBeginFrame(&latencyStats);  // Waits and polls input, EndDrawing no longer does
+#endif
         ProcessInputs();
         Update();
         Draw();
+#ifdef LATENCY_PROFILER
+        LatencyEndFrame(&latencyStats);    // Swaps buffers
+#endif
     }
 
     /* ---------------------------- De-Initialization --------------------------- */
+#ifdef LATENCY_PROFILER
+    LatencyUnload(&latencyStats);
+#endif
+    WorldSaveUnload(&worldSave);
+    WorldMapUnload(&worldMap);
     UnloadRenderTexture(viewport.renderTexture2D);
     UnloadTexture(tex_selector);
     UnloadTexture(tex_tileset);
@@ -206,19 +234,17 @@ static void InitLoadScreen()
 
 static void InitGame(int saveSlot)
 {
-    gameState.player.velocity.x = 0;
-    gameState.player.velocity.y = 0;
+    PlayerStop(&gameState.player);
 
     if(saveSlot >= NUM_SAVES) return;
     gameState.saveSlot = saveSlot;
     if(!loadScreenState.saves[saveSlot].exists)
     {
-        gameState.player.rect.x = gameState.player.rect.y = TILE_WIDTH+2;
+        PlayerSetPosition(&gameState.player, TILE_WIDTH+2, TILE_WIDTH+2);
         return;
     }
 
-    gameState.player.rect.x = loadScreenState.saves[saveSlot].x;
-    gameState.player.rect.y = loadScreenState.saves[saveSlot].y;
+    PlayerSetPosition(&gameState.player, loadScreenState.saves[saveSlot].x, loadScreenState.saves[saveSlot].y);
 }
 
 static void ProcessInputs()
@@ -226,6 +252,11 @@ static void ProcessInputs()
     editorCommands = editorCommandsEmpty;
     commandState = commandStateEmpty;
 
+#ifdef LATENCY_PROFILER
+    if(IsKeyPressed(KEY_F2)) commandState.cycleLatencyMode = true;
+    if(IsKeyPressed(KEY_F3)) commandState.toggleProfiler = true;
+#endif
+
     /* -------------------------- Process Title Screen -------------------------- */
     if(gameScreen == GAMESCREEN_TITLE)
     {
@@ -258,6 +289,18 @@ static void ProcessInputs()
         {
             editorState.rectangleOrigin =  editorState.cursorPos;
         }
+        if(IsKeyPressed(KEY_M)) editorCommands.toggle = true;
+        if(worldMap.visible)
+        {
+            // Clicking a room on the world map moves the editor there
+            int roomX, roomY;
+            if(IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && WorldMapGetRoomAt(viewport.rectDest, GetMousePosition(), &roomX, &roomY))
+            {
+                editorCommands.moveX = roomX - gameState.currentRoom.x;
+                editorCommands.moveY = roomY - gameState.currentRoom.y;
+            }
+            return;
+        }
         if(IsKeyDown(KEY_LEFT_CONTROL))
         {
             if(IsKeyPressed(KEY_S)) editorCommands.save = true;
@@ -295,6 +338,12 @@ static void ProcessInputs()
 
 static void Update()
 {
+#ifdef LATENCY_PROFILER
+    /* --------------------------------- Profiler ------------------------------- */
+    if(commandState.cycleLatencyMode) LatencySetMode(&latencyStats, (latencyStats.mode + 1) % LATENCY_MODE_COUNT);
+    if(commandState.toggleProfiler) LatencySetEnabled(&latencyStats, !latencyStats.enabled);
+#endif
+
     /* --------------------------- Title Screen Update -------------------------- */
     if(gameScreen == GAMESCREEN_TITLE)
     {
@@ -323,9 +372,11 @@ static void Update()
     /* ------------------------------ Editor Update ----------------------------- */
     if(editorState.active)
     {
-        if(editorCommands.save) RoomSave(&gameState.currentRoom);
-        gameState.player.rect.x += editorCommands.moveX * RoomGetWidth();
-        gameState.player.rect.y += editorCommands.moveY * RoomGetHeight();
+        if(editorCommands.toggle) worldMap.visible = !worldMap.visible;
+        if(editorCommands.set) EditorSetTiles();
+        if(editorCommands.save) WorldSaveRequest(&worldSave);
+        WorldSaveUpdate(&worldSave);
+        PlayerTranslate(&gameState.player, editorCommands.moveX * RoomGetWidth(), editorCommands.moveY * RoomGetHeight());
         
         GameStateUpdateCurrentRoom(&gameState);
         worldSpaceCamera.target.x = gameState.currentRoom.x * RoomGetWidth();
@@ -334,24 +385,19 @@ static void Update()
     }
 
     /* ---------------------------- Game State Update --------------------------- */
-    if(commandState.save && CheckCollisionGridTileRec(&gameState.currentRoom, TILE_SAVE, gameState.player.rect)) GameSave(gameState);
+    if(commandState.save && CheckCollisionGridTileRec(&gameState.currentRoom, TILE_SAVE, PlayerGetRect(&gameState.player))) GameSave(gameState);
 
     /* ---------------------------------- Jump ---------------------------------- */
     if(persistentCommands.jump.expiredEpoch > gameState.epoch)
     {
-        Rectangle rec = gameState.player.rect;
-        rec.y += 2;
-        if(CheckCollisionGridTileRec(&gameState.currentRoom, TILE_WALL, rec))
+        if(PlayerIsGrounded(&gameState.player, &gameState.currentRoom))
         {
-            gameState.player.velocity.y = -4.0f;
+            PlayerJump(&gameState.player);
             persistentCommands.jump.expiredEpoch = 0;
         }
     }
 
-    gameState.player.velocity.x = commandState.move * 2;
-    gameState.player.velocity.y += 0.2f;
-    PlayerMoveX(gameState.player.velocity.x);
-    PlayerMoveY(gameState.player.velocity.y);
+    PlayerStep(&gameState.player, &gameState.currentRoom, commandState.move);
 
     /* ------------------------------- Room Change ------------------------------ */
     GameStateUpdateCurrentRoom(&gameState);
@@ -363,6 +409,8 @@ static void Update()
 
 static void Draw()
 {
+    WorldMapUpload(&worldMap);
+
     /* -------------------------------- Viewport -------------------------------- */
     BeginTextureMode(viewport.renderTexture2D);
     BeginMode2D(worldSpaceCamera);
@@ -394,7 +442,17 @@ static void Draw()
     BeginDrawing();
     BeginMode2D(screenSpaceCamera);
     DrawViewport();
+    if(editorState.active && worldMap.visible)
+    {
+        WorldMapDraw(&worldMap, viewport.rectDest, gameState.currentRoom.x, gameState.currentRoom.y);
+    }
+    if(editorState.active) DrawEditorStatus();
+#ifdef LATENCY_PROFILER
+    if(latencyStats.enabled) LatencyDrawOverlay(&latencyStats, 10, 10);
+    if(!latencyStats.frameControl) DrawFPS(GetScreenWidth() - 95, 10);
+#else
     DrawFPS(GetScreenWidth() - 95, 10);
+#endif
     EndMode2D();
     EndDrawing();
 }
@@ -435,7 +493,7 @@ static void DrawWorld()
     }
 
     /* ------------------------------- Draw Player ------------------------------ */
-    DrawRectangleRec(gameState.player.rect, WHITE);
+    DrawRectangleRec(PlayerGetRect(&gameState.player), WHITE);
 }
 
 static void DrawEditorUI()
@@ -452,6 +510,33 @@ static void DrawEditorUI()
     DrawRectangleLinesEx((Rectangle){x,y,w,h}, 1.0f, GREEN);
 }
 
+static void DrawEditorStatus()
+{
+    WorldSaveReport report = WorldSaveGetReport(&worldSave);
+    const char *text = TextFormat("Last save: %i cells, %i bytes", report.cells, report.worldBytes + report.journalBytes);
+    if(report.failed) text = "Last save failed, edits kept in memory";
+    DrawText(text, 10, GetScreenHeight() - 20, 10, report.failed ? RED : WHITE);
+}
+
+static void EditorSetTiles()
+{
+    int x0 = fmin(editorState.cursorPos.x, editorState.rectangleOrigin.x);
+    int y0 = fmin(editorState.cursorPos.y, editorState.rectangleOrigin.y);
+    int x1 = fmax(editorState.cursorPos.x, editorState.rectangleOrigin.x);
+    int y1 = fmax(editorState.cursorPos.y, editorState.rectangleOrigin.y);
+
+    for(int y = y0; y <= y1; y++)
+    {
+        for(int x = x0; x <= x1; x++)
+        {
+            if(GridGet(&gameState.currentRoom, x, y) == editorState.tileValue) continue;
+            GridSet(&gameState.currentRoom, editorState.tileValue, x, y);
+            WorldSaveMarkCell(&worldSave, &gameState.currentRoom, x, y);
+        }
+    }
+    WorldMapInvalidateRoom(&worldMap, &gameState.currentRoom);
+}
+
 const Viewport ViewportInit(int width, int height, int scale)
 {
     Rectangle rectSource = {0, 0, width, -height};
@@ -467,23 +552,26 @@ const Viewport ViewportInit(int width, int height, int scale)
 
 void GameStateUpdateCurrentRoom(GameState *gameState)
 {
-    if(gameState->currentRoom.x != floor(RecGetCenterX(gameState->player.rect) / RoomGetWidth()))
+    // X truncates toward zero like the original int division, only Y floors
+    int roomX = PlayerGetCenterX(&gameState->player) / RoomGetWidth();
+    int roomY = FloorDiv(PlayerGetTop(&gameState->player), RoomGetHeight());
+    if(gameState->currentRoom.x != roomX)
     {
-        gameState->currentRoom.x = floor(RecGetCenterX(gameState->player.rect) / RoomGetWidth());
-        RoomLoad(&gameState->currentRoom);
+        gameState->currentRoom.x = roomX;
+        WorldSaveLoadRoom(&worldSave, &gameState->currentRoom);
     }
-    else if(gameState->currentRoom.y != floor(gameState->player.rect.y / RoomGetHeight()))
+    else if(gameState->currentRoom.y != roomY)
     {
-        gameState->currentRoom.y = floor(gameState->player.rect.y / RoomGetHeight());
-        RoomLoad(&gameState->currentRoom);
+        gameState->currentRoom.y = roomY;
+        WorldSaveLoadRoom(&worldSave, &gameState->currentRoom);
     }
 }
 
 void GameSave()
 {
     int data[2];
-    data[0] = gameState.player.rect.x;
-    data[1] = gameState.player.rect.y;
+    data[0] = PlayerGetLeft(&gameState.player);
+    data[1] = PlayerGetTop(&gameState.player);
 
     char *filename = FILENAME_SAVE_1;
     if(gameState.saveSlot == 1) filename = FILENAME_SAVE_2;
@@ -512,50 +600,61 @@ SaveData GetSaveData(const char *filename)
     
 }
 
-static void PlayerMoveX(float amount)
+static int RunPhysicsBenchmark(int frames)
 {
-    gameState.player.movementRemainder.x += amount;
-    int move = round(gameState.player.movementRemainder.x);
-    if(move == 0) return;
-    gameState.player.movementRemainder.x -= move;
-    int dir = signf(move);
-    while(move != 0)
+    gameScreen = GAMESCREEN_PLAY;
+    gameState.currentRoom.width = ROOM_WIDTH;
+    gameState.currentRoom.x = gameState.currentRoom.y = 0;
+    PlayerInit(&gameState.player);
+    PlayerSetPosition(&gameState.player, TILE_WIDTH+2, TILE_WIDTH+2);
+
+    // Closed room with a few platforms, so the replay does not depend on world.bin
+    GridFill(&gameState.currentRoom, TILE_EMPTY);
+    for(int x = 0; x < ROOM_WIDTH; x++)
     {
-        Rectangle rect = gameState.player.rect;
-        rect.x += dir;
-        if(CheckCollisionGridTileRec(&gameState.currentRoom, TILE_WALL, rect))
-        {
-            gameState.player.velocity.x = 0;
-            break;
-        }
-        gameState.player.rect.x += dir;
-        move -= dir;
+        GridSet(&gameState.currentRoom, TILE_WALL, x, 0);
+        GridSet(&gameState.currentRoom, TILE_WALL, x, ROOM_HEIGHT - 1);
+        if(x > 3 && x < 9) GridSet(&gameState.currentRoom, TILE_WALL, x, ROOM_HEIGHT - 4);
+        if(x > 10 && x < 17) GridSet(&gameState.currentRoom, TILE_WALL, x, ROOM_HEIGHT - 7);
+    }
+    for(int y = 0; y < ROOM_HEIGHT; y++)
+    {
+        GridSet(&gameState.currentRoom, TILE_WALL, 0, y);
+        GridSet(&gameState.currentRoom, TILE_WALL, ROOM_WIDTH - 1, y);
     }
+    persistentCommands.jump.lifetime = 5;
 
-    return;
-}
+    unsigned int seed = 1;
+    unsigned int hash = 2166136261u;
+    int move = 0;
+    clock_t start = clock();
 
-static void PlayerMoveY(float amount)
-{
-    gameState.player.movementRemainder.y += amount;
-    int move = round(gameState.player.movementRemainder.y);
-    if(move == 0) return;
-    gameState.player.movementRemainder.y -= move;
-    int dir = signf(move);
-    while(move != 0)
+    for(int i = 0; i < frames; i++)
     {
-        Rectangle rect = gameState.player.rect;
-        rect.y += dir;
-        if(CheckCollisionGridTileRec(&gameState.currentRoom, TILE_WALL, rect))
-        {
-            gameState.player.velocity.y = 0;
-            break;
-        }
-        gameState.player.rect.y += dir;
-        move -= dir;
+        // Same LCG on every build so every build replays the same inputs
+        seed = seed * 1103515245u + 12345u;
+        if(i % 30 == 0) move = (int)((seed >> 16) % 3) - 1;
+        commandState = commandStateEmpty;
+        commandState.move = move;
+        if((seed >> 16) % 16 == 0) persistentCommands.jump.expiredEpoch = gameState.epoch + persistentCommands.jump.lifetime;
+
+        Update();
+        hash = PlayerHash(&gameState.player, hash);
+        hash = HashBytes(hash, &gameState.currentRoom.x, sizeof(int));
+        hash = HashBytes(hash, &gameState.currentRoom.y, sizeof(int));
     }
 
-    return;
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+#ifdef PHYSICS_FIXED_POINT
+    const char *path = "fixed";
+#else
+    const char *path = "float";
+#endif
+    Rectangle rect = PlayerGetRect(&gameState.player);
+    printf("physics: %s frames: %d position: %d,%d hash: %08x time: %.3f ms (%.1f ns/frame)\n",
+        path, frames, (int)rect.x, (int)rect.y, hash, seconds * 1000.0, frames > 0 ? seconds * 1e9 / frames : 0.0);
+
+    return 0;
 }
 
 Int2 GetPositionWindowToWorldGrid(Vector2 position)
@@ -0,0 +1,212 @@
+#include <math.h>
+#include "player.h"
+
+static void PlayerMoveX(Player *player, const Grid *room);
+static void PlayerMoveY(Player *player, const Grid *room);
+
+void PlayerInit(Player *player)
+{
+    PlayerSetPosition(player, 0, 0);
+    PlayerStop(player);
+#ifdef PHYSICS_FIXED_POINT
+    player->width = PLAYER_WIDTH;
+    player->height = PLAYER_HEIGHT;
+    player->remainderX = player->remainderY = 0;
+#else
+    player->rect.width = PLAYER_WIDTH;
+    player->rect.height = PLAYER_HEIGHT;
+    player->movementRemainder.x = player->movementRemainder.y = 0.0f;
+#endif
+}
+
+void PlayerSetPosition(Player *player, int x, int y)
+{
+#ifdef PHYSICS_FIXED_POINT
+    player->x = x;
+    player->y = y;
+#else
+    player->rect.x = x;
+    player->rect.y = y;
+#endif
+}
+
+void PlayerTranslate(Player *player, int x, int y)
+{
+#ifdef PHYSICS_FIXED_POINT
+    player->x += x;
+    player->y += y;
+#else
+    player->rect.x += x;
+    player->rect.y += y;
+#endif
+}
+
+void PlayerStop(Player *player)
+{
+#ifdef PHYSICS_FIXED_POINT
+    player->velocityX = player->velocityY = 0;
+#else
+    player->velocity.x = player->velocity.y = 0.0f;
+#endif
+}
+
+void PlayerJump(Player *player)
+{
+#ifdef PHYSICS_FIXED_POINT
+    player->velocityY = FIXED_FROM_FLOAT(PLAYER_JUMP_SPEED);
+#else
+    player->velocity.y = PLAYER_JUMP_SPEED;
+#endif
+}
+
+void PlayerStep(Player *player, const Grid *room, int move)
+{
+#ifdef PHYSICS_FIXED_POINT
+    player->velocityX = move * PLAYER_RUN_SPEED * FIXED_ONE;
+    player->velocityY += FIXED_FROM_FLOAT(PLAYER_GRAVITY);
+#else
+    player->velocity.x = move * PLAYER_RUN_SPEED;
+    player->velocity.y += PLAYER_GRAVITY;
+#endif
+    PlayerMoveX(player, room);
+    PlayerMoveY(player, room);
+}
+
+const bool PlayerIsGrounded(const Player *player, const Grid *room)
+{
+#ifdef PHYSICS_FIXED_POINT
+    return CheckCollisionGridTileBox(room, TILE_WALL, player->x, player->y + 2, player->width, player->height);
+#else
+    Rectangle rec = player->rect;
+    rec.y += 2;
+    return CheckCollisionGridTileRec(room, TILE_WALL, rec);
+#endif
+}
+
+const Rectangle PlayerGetRect(const Player *player)
+{
+#ifdef PHYSICS_FIXED_POINT
+    return (Rectangle){player->x, player->y, player->width, player->height};
+#else
+    return player->rect;
+#endif
+}
+
+// Integer position for game logic, the player only ever moves by whole pixels
+int PlayerGetLeft(const Player *player)
+{
+#ifdef PHYSICS_FIXED_POINT
+    return player->x;
+#else
+    return (int)player->rect.x;
+#endif
+}
+
+int PlayerGetCenterX(const Player *player)
+{
+#ifdef PHYSICS_FIXED_POINT
+    return player->x + player->width / 2;
+#else
+    return (int)player->rect.x + (int)player->rect.width / 2;
+#endif
+}
+
+int PlayerGetTop(const Player *player)
+{
+#ifdef PHYSICS_FIXED_POINT
+    return player->y;
+#else
+    return (int)player->rect.y;
+#endif
+}
+
+unsigned int PlayerHash(const Player *player, unsigned int hash)
+{
+    return HashBytes(hash, player, sizeof(Player));
+}
+
+#ifdef PHYSICS_FIXED_POINT
+
+static void PlayerMoveX(Player *player, const Grid *room)
+{
+    player->remainderX += player->velocityX;
+    int move = FixedRound(player->remainderX);
+    if(move == 0) return;
+    player->remainderX -= move * FIXED_ONE;
+    int dir = move > 0 ? 1 : -1;
+    while(move != 0)
+    {
+        if(CheckCollisionGridTileBox(room, TILE_WALL, player->x + dir, player->y, player->width, player->height))
+        {
+            player->velocityX = 0;
+            break;
+        }
+        player->x += dir;
+        move -= dir;
+    }
+}
+
+static void PlayerMoveY(Player *player, const Grid *room)
+{
+    player->remainderY += player->velocityY;
+    int move = FixedRound(player->remainderY);
+    if(move == 0) return;
+    player->remainderY -= move * FIXED_ONE;
+    int dir = move > 0 ? 1 : -1;
+    while(move != 0)
+    {
+        if(CheckCollisionGridTileBox(room, TILE_WALL, player->x, player->y + dir, player->width, player->height))
+        {
+            player->velocityY = 0;
+            break;
+        }
+        player->y += dir;
+        move -= dir;
+    }
+}
+
+#else
+
+static void PlayerMoveX(Player *player, const Grid *room)
+{
+    player->movementRemainder.x += player->velocity.x;
+    int move = round(player->movementRemainder.x);
+    if(move == 0) return;
+    player->movementRemainder.x -= move;
+    int dir = signf(move);
+    while(move != 0)
+    {
+        Rectangle rect = player->rect;
+        rect.x += dir;
+        if(CheckCollisionGridTileRec(room, TILE_WALL, rect))
+        {
+            player->velocity.x = 0;
+            break;
+        }
+        player->rect.x += dir;
+        move -= dir;
+    }
+}
+
+static void PlayerMoveY(Player *player, const Grid *room)
+{
+    player->movementRemainder.y += player->velocity.y;
+    int move = round(player->movementRemainder.y);
+    if(move == 0) return;
+    player->movementRemainder.y -= move;
+    int dir = signf(move);
+    while(move != 0)
+    {
+        Rectangle rect = player->rect;
+        rect.y += dir;
+        if(CheckCollisionGridTileRec(room, TILE_WALL, rect))
+        {
+            player->velocity.y = 0;
+            break;
+        }
+        player->rect.y += dir;
+        move -= dir;
+    }
+}
+
+#endif
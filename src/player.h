@@ -0,0 +1,41 @@
+#ifndef PLAYER_H
+#define PLAYER_H
+
+#include "raylib.h"
+#include "utils.h"
+#include "grid.h"
+
+// Build with PHYSICS_FIXED_POINT to run movement and collision on integers only,
+// so the simulation gives the same results on every compiler and platform
+typedef struct Player
+{
+#ifdef PHYSICS_FIXED_POINT
+    int x;
+    int y;
+    int width;
+    int height;
+    Fixed velocityX;
+    Fixed velocityY;
+    Fixed remainderX;
+    Fixed remainderY;
+#else
+    Rectangle rect;
+    Vector2 velocity;
+    Vector2 movementRemainder;
+#endif
+} Player;
+
+void PlayerInit(Player *player);
+void PlayerSetPosition(Player *player, int x, int y);
+void PlayerTranslate(Player *player, int x, int y);
+void PlayerStop(Player *player);
+void PlayerJump(Player *player);
+void PlayerStep(Player *player, const Grid *room, int move);
+const bool PlayerIsGrounded(const Player *player, const Grid *room);
+const Rectangle PlayerGetRect(const Player *player);
+int PlayerGetLeft(const Player *player);
+int PlayerGetCenterX(const Player *player);
+int PlayerGetTop(const Player *player);
+unsigned int PlayerHash(const Player *player, unsigned int hash);
+
+#endif
\ No newline at end of file
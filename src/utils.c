@@ -5,4 +5,30 @@ int signf(float f)
     if (f > 0) return 1;
     if (f < 0) return -1;
     return 0;
+}
+
+// Nearest pixel, halfway rounds away from zero like round()
+int FixedRound(Fixed f)
+{
+    if (f < 0) return -((-f + FIXED_ONE / 2) >> FIXED_SHIFT);
+    return (f + FIXED_ONE / 2) >> FIXED_SHIFT;
+}
+
+// Rounds toward negative infinity like floor(), b must be positive
+int FloorDiv(int a, int b)
+{
+    if (a < 0) return -((-a + b - 1) / b);
+    return a / b;
+}
+
+// FNV-1a, start with hash = 2166136261
+unsigned int HashBytes(unsigned int hash, const void *data, int size)
+{
+    const unsigned char *bytes = data;
+    for (int i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
 }
\ No newline at end of file
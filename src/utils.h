@@ -1,6 +1,16 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+// Fixed-point sub-pixel value, FIXED_ONE units per pixel
+typedef int Fixed;
+#define FIXED_SHIFT 8
+#define FIXED_ONE (1 << FIXED_SHIFT)
+// Only use on constants, the conversion is then done by the compiler
+#define FIXED_FROM_FLOAT(f) ((Fixed)((f) * FIXED_ONE + ((f) >= 0 ? 0.5f : -0.5f)))
+
 int signf(float f);
+int FixedRound(Fixed f);
+int FloorDiv(int a, int b);
+unsigned int HashBytes(unsigned int hash, const void *data, int size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,366 @@
+#include <string.h>
+#include <math.h>
+#include "worldmap.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <tmmintrin.h>
+    #define WORLDMAP_KERNEL_SSSE3
+#elif defined(__aarch64__)
+    #include <arm_neon.h>
+    #define WORLDMAP_KERNEL_NEON
+#endif
+
+#if (ROOM_WIDTH * ROOM_HEIGHT) % 16 != 0
+    #error "The SIMD tile kernels process rooms 16 cells at a time"
+#endif
+
+static void *WorldMapWorker(void *arg);
+static void WorldMapLoadWorld(WorldMap *map);
+static bool WorldMapRasterizeNext(WorldMap *map);
+static Rectangle WorldMapGetPageRooms(int page);
+static void WorldMapRasterize(const WorldMap *map, const unsigned char *tiles, uint32_t *pixels);
+static void WorldMapPushRaster(WorldMap *map, int room);
+static void WorldMapPushUpload(WorldMap *map, int room);
+
+void WorldMapInit(WorldMap *map, const char *tilesetFilename)
+{
+    /* ------------------------- Palette From Tileset -------------------------- */
+    // Each tile ID gets the average opaque color of its tile in the tileset
+    Image tileset = LoadImage(tilesetFilename);
+    Color *colors = LoadImageColors(tileset);
+    for(int t = 0; t < WORLDMAP_PALETTE_SIZE; t++)
+    {
+        Color color = BLANK;
+        if((t + 1) * TILE_WIDTH > tileset.width || TILE_HEIGHT > tileset.height) continue;
+        int r = 0, g = 0, b = 0, count = 0;
+        for(int y = 0; y < TILE_HEIGHT; y++)
+        {
+            for(int x = 0; x < TILE_WIDTH; x++)
+            {
+                Color c = colors[y * tileset.width + t * TILE_WIDTH + x];
+                if(c.a == 0) continue;
+                r += c.r; g += c.g; b += c.b;
+                count++;
+            }
+        }
+        if(count > 0) color = (Color){r / count, g / count, b / count, 255};
+
+        map->palette[t] = color.r | color.g << 8 | color.b << 16 | (uint32_t)color.a << 24;
+        map->paletteChannels[0][t] = color.r;
+        map->paletteChannels[1][t] = color.g;
+        map->paletteChannels[2][t] = color.b;
+        map->paletteChannels[3][t] = color.a;
+    }
+    UnloadImageColors(colors);
+    UnloadImage(tileset);
+
+    /* ------------------------------- Atlas ----------------------------------- */
+    for(int page = 0; page < WORLDMAP_PAGES_X * WORLDMAP_PAGES_Y; page++)
+    {
+        Rectangle rooms = WorldMapGetPageRooms(page);
+        Image blank = GenImageColor(rooms.width * ROOM_WIDTH, rooms.height * ROOM_HEIGHT, BLANK);
+        map->pages[page] = LoadTextureFromImage(blank);
+        UnloadImage(blank);
+    }
+
+    /* ------------------------------ Buffers ---------------------------------- */
+    map->tiles = MemAlloc(WORLD_ROOMS_LENGTH * ROOM_CELLS_LENGTH);
+    map->thumbnails = MemAlloc(WORLD_ROOMS_LENGTH * ROOM_CELLS_LENGTH * sizeof(uint32_t));
+    map->staging = MemAlloc(WORLDMAP_UPLOAD_BATCH * ROOM_CELLS_LENGTH * sizeof(uint32_t));
+    map->dirty = MemAlloc(WORLD_ROOMS_LENGTH);
+    map->ready = MemAlloc(WORLD_ROOMS_LENGTH);
+    map->rasterQueue = MemAlloc(WORLD_ROOMS_LENGTH * sizeof(int));
+    map->uploadQueue = MemAlloc(WORLD_ROOMS_LENGTH * sizeof(int));
+    map->rasterHead = map->rasterCount = 0;
+    map->uploadHead = map->uploadCount = 0;
+    map->visible = false;
+
+    /* ------------------------------- Worker ---------------------------------- */
+    pthread_mutex_init(&map->mutex, NULL);
+    pthread_cond_init(&map->cond, NULL);
+    map->running = true;
+    map->threaded = pthread_create(&map->thread, NULL, WorldMapWorker, map) == 0;
+    if(!map->threaded)
+    {
+        TraceLog(LOG_WARNING, "WORLDMAP: Worker thread unavailable, thumbnails are rasterized on the main thread");
+        WorldMapLoadWorld(map);
+    }
+}
+
+void WorldMapUnload(WorldMap *map)
+{
+    pthread_mutex_lock(&map->mutex);
+    map->running = false;
+    pthread_cond_signal(&map->cond);
+    pthread_mutex_unlock(&map->mutex);
+    if(map->threaded) pthread_join(map->thread, NULL);
+
+    pthread_cond_destroy(&map->cond);
+    pthread_mutex_destroy(&map->mutex);
+    for(int page = 0; page < WORLDMAP_PAGES_X * WORLDMAP_PAGES_Y; page++) UnloadTexture(map->pages[page]);
+    MemFree(map->tiles);
+    MemFree(map->thumbnails);
+    MemFree(map->staging);
+    MemFree(map->dirty);
+    MemFree(map->ready);
+    MemFree(map->rasterQueue);
+    MemFree(map->uploadQueue);
+}
+
+// Snapshot the room cells and queue its thumbnail for regeneration
+void WorldMapInvalidateRoom(WorldMap *map, const Grid *room)
+{
+    if(room->x < 0 || room->x >= WORLD_WIDTH) return;
+    if(room->y < 0 || room->y >= WORLD_HEIGHT) return;
+    int index = room->y * WORLD_WIDTH + room->x;
+
+    pthread_mutex_lock(&map->mutex);
+    unsigned char *tiles = map->tiles + index * ROOM_CELLS_LENGTH;
+    for(int i = 0; i < ROOM_CELLS_LENGTH; i++)
+    {
+        tiles[i] = room->cells[i];
+    }
+    WorldMapPushRaster(map, index);
+    pthread_cond_signal(&map->cond);
+    pthread_mutex_unlock(&map->mutex);
+}
+
+// Upload a batch of finished thumbnails, must be called from the main thread.
+// The batch is copied out under the lock so the GPU upload does not block the worker.
+void WorldMapUpload(WorldMap *map)
+{
+    if(!map->threaded)
+    {
+        for(int i = 0; i < WORLDMAP_UPLOAD_BATCH && WorldMapRasterizeNext(map); i++);
+    }
+
+    int rooms[WORLDMAP_UPLOAD_BATCH];
+    int count = 0;
+    pthread_mutex_lock(&map->mutex);
+    while(count < WORLDMAP_UPLOAD_BATCH && map->uploadCount > 0)
+    {
+        int room = map->uploadQueue[map->uploadHead];
+        map->uploadHead = (map->uploadHead + 1) % WORLD_ROOMS_LENGTH;
+        map->uploadCount--;
+        map->ready[room] = false;
+        memcpy(map->staging + count * ROOM_CELLS_LENGTH, map->thumbnails + room * ROOM_CELLS_LENGTH, ROOM_CELLS_LENGTH * sizeof(uint32_t));
+        rooms[count++] = room;
+    }
+    pthread_mutex_unlock(&map->mutex);
+
+    for(int i = 0; i < count; i++)
+    {
+        int x = rooms[i] % WORLD_WIDTH;
+        int y = rooms[i] / WORLD_WIDTH;
+        int page = y / WORLDMAP_PAGE_ROOMS * WORLDMAP_PAGES_X + x / WORLDMAP_PAGE_ROOMS;
+        Rectangle rec = {x % WORLDMAP_PAGE_ROOMS * ROOM_WIDTH, y % WORLDMAP_PAGE_ROOMS * ROOM_HEIGHT, ROOM_WIDTH, ROOM_HEIGHT};
+        UpdateTextureRec(map->pages[page], rec, map->staging + i * ROOM_CELLS_LENGTH);
+    }
+}
+
+void WorldMapDraw(const WorldMap *map, Rectangle bounds, int roomX, int roomY)
+{
+    Rectangle dest = WorldMapGetRect(bounds);
+    float scale = dest.width / (WORLD_WIDTH * ROOM_WIDTH);
+
+    DrawRectangleRec(bounds, Fade(BLACK, 0.8f));
+    for(int page = 0; page < WORLDMAP_PAGES_X * WORLDMAP_PAGES_Y; page++)
+    {
+        Rectangle rooms = WorldMapGetPageRooms(page);
+        Rectangle src = {0, 0, map->pages[page].width, map->pages[page].height};
+        Rectangle pageDest = {dest.x + rooms.x * ROOM_WIDTH * scale, dest.y + rooms.y * ROOM_HEIGHT * scale, src.width * scale, src.height * scale};
+        DrawTexturePro(map->pages[page], src, pageDest, (Vector2){0.0f, 0.0f}, 0.0f, WHITE);
+    }
+
+    Rectangle current = {dest.x + roomX * ROOM_WIDTH * scale, dest.y + roomY * ROOM_HEIGHT * scale, ROOM_WIDTH * scale, ROOM_HEIGHT * scale};
+    DrawRectangleLinesEx(current, 2.0f, GREEN);
+}
+
+// Largest integer scale of the atlas that fits in bounds, centered
+const Rectangle WorldMapGetRect(Rectangle bounds)
+{
+    int scale = fmin(bounds.width / (WORLD_WIDTH * ROOM_WIDTH), bounds.height / (WORLD_HEIGHT * ROOM_HEIGHT));
+    if(scale < 1) scale = 1;
+    int width = WORLD_WIDTH * ROOM_WIDTH * scale;
+    int height = WORLD_HEIGHT * ROOM_HEIGHT * scale;
+    return (Rectangle){bounds.x + (bounds.width - width) / 2, bounds.y + (bounds.height - height) / 2, width, height};
+}
+
+const bool WorldMapGetRoomAt(Rectangle bounds, Vector2 position, int *roomX, int *roomY)
+{
+    Rectangle dest = WorldMapGetRect(bounds);
+    if(!CheckCollisionPointRec(position, dest)) return false;
+    *roomX = (position.x - dest.x) / dest.width * WORLD_WIDTH;
+    *roomY = (position.y - dest.y) / dest.height * WORLD_HEIGHT;
+    return true;
+}
+
+// Area covered by an atlas page, in rooms
+static Rectangle WorldMapGetPageRooms(int page)
+{
+    int x = page % WORLDMAP_PAGES_X * WORLDMAP_PAGE_ROOMS;
+    int y = page / WORLDMAP_PAGES_X * WORLDMAP_PAGE_ROOMS;
+    return (Rectangle){x, y, fmin(WORLDMAP_PAGE_ROOMS, WORLD_WIDTH - x), fmin(WORLDMAP_PAGE_ROOMS, WORLD_HEIGHT - y)};
+}
+
+static void WorldMapPushRaster(WorldMap *map, int room)
+{
+    if(map->dirty[room]) return;
+    map->dirty[room] = true;
+    map->rasterQueue[(map->rasterHead + map->rasterCount) % WORLD_ROOMS_LENGTH] = room;
+    map->rasterCount++;
+}
+
+static void WorldMapPushUpload(WorldMap *map, int room)
+{
+    if(map->ready[room]) return;
+    map->ready[room] = true;
+    map->uploadQueue[(map->uploadHead + map->uploadCount) % WORLD_ROOMS_LENGTH] = room;
+    map->uploadCount++;
+}
+
+#if defined(WORLDMAP_KERNEL_SSSE3)
+// 16 tiles per step: each channel is a 16-entry byte shuffle, then channels are interleaved to RGBA
+__attribute__((target("ssse3")))
+static void WorldMapRasterizeSsse3(const WorldMap *map, const unsigned char *tiles, uint32_t *pixels)
+{
+    __m128i mask = _mm_set1_epi8(WORLDMAP_PALETTE_SIZE - 1);
+    __m128i red = _mm_loadu_si128((const __m128i *)map->paletteChannels[0]);
+    __m128i green = _mm_loadu_si128((const __m128i *)map->paletteChannels[1]);
+    __m128i blue = _mm_loadu_si128((const __m128i *)map->paletteChannels[2]);
+    __m128i alpha = _mm_loadu_si128((const __m128i *)map->paletteChannels[3]);
+
+    for(int i = 0; i < ROOM_CELLS_LENGTH; i += 16)
+    {
+        __m128i index = _mm_and_si128(_mm_loadu_si128((const __m128i *)(tiles + i)), mask);
+        __m128i r = _mm_shuffle_epi8(red, index);
+        __m128i g = _mm_shuffle_epi8(green, index);
+        __m128i b = _mm_shuffle_epi8(blue, index);
+        __m128i a = _mm_shuffle_epi8(alpha, index);
+
+        __m128i rgLow = _mm_unpacklo_epi8(r, g);
+        __m128i rgHigh = _mm_unpackhi_epi8(r, g);
+        __m128i baLow = _mm_unpacklo_epi8(b, a);
+        __m128i baHigh = _mm_unpackhi_epi8(b, a);
+        _mm_storeu_si128((__m128i *)(pixels + i), _mm_unpacklo_epi16(rgLow, baLow));
+        _mm_storeu_si128((__m128i *)(pixels + i + 4), _mm_unpackhi_epi16(rgLow, baLow));
+        _mm_storeu_si128((__m128i *)(pixels + i + 8), _mm_unpacklo_epi16(rgHigh, baHigh));
+        _mm_storeu_si128((__m128i *)(pixels + i + 12), _mm_unpackhi_epi16(rgHigh, baHigh));
+    }
+}
+#endif
+
+#if defined(WORLDMAP_KERNEL_NEON)
+// 16 tiles per step: one table lookup per channel, interleaved by the RGBA store
+static void WorldMapRasterizeNeon(const WorldMap *map, const unsigned char *tiles, uint32_t *pixels)
+{
+    uint8x16_t mask = vdupq_n_u8(WORLDMAP_PALETTE_SIZE - 1);
+    uint8x16_t red = vld1q_u8(map->paletteChannels[0]);
+    uint8x16_t green = vld1q_u8(map->paletteChannels[1]);
+    uint8x16_t blue = vld1q_u8(map->paletteChannels[2]);
+    uint8x16_t alpha = vld1q_u8(map->paletteChannels[3]);
+
+    for(int i = 0; i < ROOM_CELLS_LENGTH; i += 16)
+    {
+        uint8x16_t index = vandq_u8(vld1q_u8(tiles + i), mask);
+        uint8x16x4_t rgba = {{vqtbl1q_u8(red, index), vqtbl1q_u8(green, index), vqtbl1q_u8(blue, index), vqtbl1q_u8(alpha, index)}};
+        vst4q_u8((uint8_t *)(pixels + i), rgba);
+    }
+}
+#endif
+
+// Tile-to-color kernel, explicit SIMD so it does not depend on the optimization level
+static void WorldMapRasterize(const WorldMap *map, const unsigned char *tiles, uint32_t *pixels)
+{
+#if defined(WORLDMAP_KERNEL_SSSE3)
+    if(__builtin_cpu_supports("ssse3"))
+    {
+        WorldMapRasterizeSsse3(map, tiles, pixels);
+        return;
+    }
+#elif defined(WORLDMAP_KERNEL_NEON)
+    WorldMapRasterizeNeon(map, tiles, pixels);
+    return;
+#endif
+    for(int i = 0; i < ROOM_CELLS_LENGTH; i++)
+    {
+        pixels[i] = map->palette[tiles[i] & (WORLDMAP_PALETTE_SIZE - 1)];
+    }
+}
+
+// Same layout as RoomLoad: one int per cell, rooms in row-major order.
+// The lock is taken per room so invalidations and uploads are never held up by the whole world.
+static void WorldMapLoadWorld(WorldMap *map)
+{
+    int expectedDataSize = ROOM_CELLS_LENGTH * WORLD_ROOMS_LENGTH * sizeof(int);
+    int fileDataSize = 0;
+    unsigned char *data = 0;
+    if(FileExists(FILENAME_WORLD)) data = LoadFileData(FILENAME_WORLD, &fileDataSize);
+
+    for(int room = 0; room < WORLD_ROOMS_LENGTH; room++)
+    {
+        pthread_mutex_lock(&map->mutex);
+        // Rooms invalidated while the file was loading already hold newer cells
+        if(!map->dirty[room])
+        {
+            for(int i = 0; i < ROOM_CELLS_LENGTH; i++)
+            {
+                if(fileDataSize != expectedDataSize) map->tiles[room * ROOM_CELLS_LENGTH + i] = TILE_WALL;
+                else map->tiles[room * ROOM_CELLS_LENGTH + i] = data[(room * ROOM_CELLS_LENGTH + i) * sizeof(int)];
+            }
+            WorldMapPushRaster(map, room);
+        }
+        pthread_mutex_unlock(&map->mutex);
+    }
+    if(data) UnloadFileData(data);
+}
+
+// Rasterize one queued room, returns false when the queue is empty
+static bool WorldMapRasterizeNext(WorldMap *map)
+{
+    unsigned char tiles[ROOM_CELLS_LENGTH];
+    uint32_t pixels[ROOM_CELLS_LENGTH];
+
+    pthread_mutex_lock(&map->mutex);
+    if(map->rasterCount == 0)
+    {
+        pthread_mutex_unlock(&map->mutex);
+        return false;
+    }
+    int room = map->rasterQueue[map->rasterHead];
+    map->rasterHead = (map->rasterHead + 1) % WORLD_ROOMS_LENGTH;
+    map->rasterCount--;
+    map->dirty[room] = false;
+    memcpy(tiles, map->tiles + room * ROOM_CELLS_LENGTH, ROOM_CELLS_LENGTH);
+    pthread_mutex_unlock(&map->mutex);
+
+    WorldMapRasterize(map, tiles, pixels);
+
+    pthread_mutex_lock(&map->mutex);
+    memcpy(map->thumbnails + room * ROOM_CELLS_LENGTH, pixels, sizeof(pixels));
+    WorldMapPushUpload(map, room);
+    pthread_mutex_unlock(&map->mutex);
+    return true;
+}
+
+static void *WorldMapWorker(void *arg)
+{
+    WorldMap *map = arg;
+    WorldMapLoadWorld(map);
+
+    pthread_mutex_lock(&map->mutex);
+    while(map->running)
+    {
+        if(map->rasterCount == 0)
+        {
+            pthread_cond_wait(&map->cond, &map->mutex);
+            continue;
+        }
+        pthread_mutex_unlock(&map->mutex);
+        WorldMapRasterizeNext(map);
+        pthread_mutex_lock(&map->mutex);
+    }
+    pthread_mutex_unlock(&map->mutex);
+
+    return NULL;
+}
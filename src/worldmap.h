@@ -0,0 +1,50 @@
+#ifndef WORLDMAP_H
+#define WORLDMAP_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "raylib.h"
+#include "game_params.h"
+#include "grid.h"
+
+#define WORLDMAP_PALETTE_SIZE 16    // Tile IDs are masked into the palette range
+#define WORLDMAP_UPLOAD_BATCH 32    // Max thumbnails uploaded to the GPU per frame
+#define WORLDMAP_PAGE_ROOMS 64      // Rooms per atlas page side, 1280x1024 px pages stay under the 2048 px GLES limit
+#define WORLDMAP_PAGES_X ((WORLD_WIDTH + WORLDMAP_PAGE_ROOMS - 1) / WORLDMAP_PAGE_ROOMS)
+#define WORLDMAP_PAGES_Y ((WORLD_HEIGHT + WORLDMAP_PAGE_ROOMS - 1) / WORLDMAP_PAGE_ROOMS)
+
+// World overview, one pixel per tile. Thumbnails are rasterized on a worker
+// thread and uploaded into atlas pages from the main thread.
+typedef struct WorldMap
+{
+    Texture2D pages[WORLDMAP_PAGES_X * WORLDMAP_PAGES_Y];
+    uint32_t palette[WORLDMAP_PALETTE_SIZE];                    // Packed RGBA, little-endian byte order
+    unsigned char paletteChannels[4][WORLDMAP_PALETTE_SIZE];    // Same palette split per channel for the SIMD kernels
+    unsigned char *tiles;           // World snapshot, ROOM_CELLS_LENGTH per room
+    uint32_t *thumbnails;           // Rasterized rooms, ROOM_CELLS_LENGTH per room
+    uint32_t *staging;              // Batch copied out for upload, WORLDMAP_UPLOAD_BATCH rooms
+    unsigned char *dirty;           // Room waits for rasterization
+    unsigned char *ready;           // Room waits for upload
+    int *rasterQueue;
+    int rasterHead;
+    int rasterCount;
+    int *uploadQueue;
+    int uploadHead;
+    int uploadCount;
+    bool running;
+    bool threaded;                  // False when the worker could not start, work then runs in WorldMapUpload
+    bool visible;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} WorldMap;
+
+void WorldMapInit(WorldMap *map, const char *tilesetFilename);
+void WorldMapUnload(WorldMap *map);
+void WorldMapInvalidateRoom(WorldMap *map, const Grid *room);
+void WorldMapUpload(WorldMap *map);
+void WorldMapDraw(const WorldMap *map, Rectangle bounds, int roomX, int roomY);
+const Rectangle WorldMapGetRect(Rectangle bounds);
+const bool WorldMapGetRoomAt(Rectangle bounds, Vector2 position, int *roomX, int *roomY);
+
+#endif
\ No newline at end of file
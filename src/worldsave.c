@@ -0,0 +1,398 @@
+#include <stdio.h>
+#include "worldsave.h"
+#include "utils.h"
+
+#if defined(_WIN32)
+    #include <io.h>
+    #define FileSync(file) _commit(_fileno(file))
+    // rename does not overwrite on Windows, a crash in between leaves only the temp file
+    #define FileReplace(from, to) (remove(to), rename(from, to))
+#else
+    #include <unistd.h>
+    #define FileSync(file) fsync(fileno(file))
+    #define FileReplace(from, to) rename(from, to)
+#endif
+
+#define JOURNAL_MAGIC 0x4C4E4A57    // "WJNL"
+#define WORLD_DATA_SIZE (ROOM_CELLS_LENGTH * WORLD_ROOMS_LENGTH * (int)sizeof(int))
+
+// Journal layout, all ints: magic, run count, cell count,
+// then per run: file offset, cell count, values, and a trailing checksum
+
+static void *WorldSaveWorker(void *arg);
+static void WorldSaveWrite(WorldSave *save);
+static int *WorldSaveBuildJournal(WorldSave *save, int *length);
+static void WorldSaveClearWritten(WorldSave *save, const int *journal);
+static void WorldSaveImportJournal(WorldSave *save, const int *journal);
+static bool JournalCheck(const int *journal, int length);
+static bool JournalWrite(const int *journal, int length);
+static bool JournalApply(const int *journal, int *worldBytes);
+
+void WorldSaveInit(WorldSave *save)
+{
+    save->values = MemAlloc(WORLD_ROOMS_LENGTH * ROOM_CELLS_LENGTH * sizeof(int));
+    save->dirtyCells = MemAlloc(WORLD_ROOMS_LENGTH * ROOM_CELLS_LENGTH);
+    save->dirtyRooms = MemAlloc(WORLD_ROOMS_LENGTH);
+    save->roomList = MemAlloc(WORLD_ROOMS_LENGTH * sizeof(int));
+    save->roomCount = 0;
+    save->lastSaveTime = GetTime();
+    save->saveRequested = false;
+    save->saveCount = 0;
+    save->report = (WorldSaveReport){0};
+
+    /* ---------------------------- Crash Recovery ----------------------------- */
+    // A complete journal means the last save may be half applied, replay it.
+    // An incomplete one was never applied, the world file is still intact.
+    // If the replay fails the journal is kept and its edits become pending again.
+    // A temp journal is only used when the rename over the journal was cut short.
+    if(FileExists(FILENAME_WORLD_JOURNAL_TEMP))
+    {
+        if(FileExists(FILENAME_WORLD_JOURNAL)) remove(FILENAME_WORLD_JOURNAL_TEMP);
+        else rename(FILENAME_WORLD_JOURNAL_TEMP, FILENAME_WORLD_JOURNAL);
+    }
+    if(FileExists(FILENAME_WORLD_JOURNAL))
+    {
+        int dataSize = 0;
+        int worldBytes = 0;
+        unsigned char *data = LoadFileData(FILENAME_WORLD_JOURNAL, &dataSize);
+        if(!JournalCheck((int *)data, dataSize / sizeof(int)))
+        {
+            TraceLog(LOG_WARNING, "WORLDSAVE: Discarded incomplete journal of %i bytes", dataSize);
+            remove(FILENAME_WORLD_JOURNAL);
+        }
+        else if(JournalApply((int *)data, &worldBytes))
+        {
+            TraceLog(LOG_INFO, "WORLDSAVE: Replayed journal of %i bytes, %i bytes to world", dataSize, worldBytes);
+            remove(FILENAME_WORLD_JOURNAL);
+        }
+        else
+        {
+            TraceLog(LOG_WARNING, "WORLDSAVE: Could not write journal to %s, kept it and its %i cells for the next save", FILENAME_WORLD, ((int *)data)[2]);
+            WorldSaveImportJournal(save, (int *)data);
+        }
+        UnloadFileData(data);
+    }
+
+    /* ------------------------------- Worker ---------------------------------- */
+    pthread_mutex_init(&save->mutex, NULL);
+    pthread_cond_init(&save->cond, NULL);
+    save->running = true;
+    save->threaded = pthread_create(&save->thread, NULL, WorldSaveWorker, save) == 0;
+    if(!save->threaded) TraceLog(LOG_WARNING, "WORLDSAVE: Worker thread unavailable, saves run on the main thread");
+}
+
+// Writes pending edits before the worker stops
+void WorldSaveUnload(WorldSave *save)
+{
+    pthread_mutex_lock(&save->mutex);
+    if(save->roomCount > 0) save->saveRequested = true;
+    save->running = false;
+    if(!save->threaded) WorldSaveWrite(save);
+    pthread_cond_signal(&save->cond);
+    pthread_mutex_unlock(&save->mutex);
+    if(save->threaded) pthread_join(save->thread, NULL);
+
+    pthread_cond_destroy(&save->cond);
+    pthread_mutex_destroy(&save->mutex);
+    MemFree(save->values);
+    MemFree(save->dirtyCells);
+    MemFree(save->dirtyRooms);
+    MemFree(save->roomList);
+}
+
+void WorldSaveMarkCell(WorldSave *save, const Grid *room, int x, int y)
+{
+    if(room->x < 0 || room->x >= WORLD_WIDTH) return;
+    if(room->y < 0 || room->y >= WORLD_HEIGHT) return;
+    if(x < 0 || x >= room->width) return;
+    if(y < 0 || y >= GridGetHeight(*room)) return;
+    int index = room->y * WORLD_WIDTH + room->x;
+    int cell = index * ROOM_CELLS_LENGTH + y * room->width + x;
+
+    pthread_mutex_lock(&save->mutex);
+    save->values[cell] = GridGet(room, x, y);
+    save->dirtyCells[cell] = true;
+    if(!save->dirtyRooms[index])
+    {
+        save->dirtyRooms[index] = true;
+        save->roomList[save->roomCount++] = index;
+    }
+    pthread_mutex_unlock(&save->mutex);
+}
+
+// Loads a room from the world file and overlays edits not yet written.
+// Rooms outside the world are solid walls, they have no data in the file.
+void WorldSaveLoadRoom(WorldSave *save, Grid *room)
+{
+    if(room->x < 0 || room->x >= WORLD_WIDTH || room->y < 0 || room->y >= WORLD_HEIGHT)
+    {
+        GridFill(room, TILE_WALL);
+        return;
+    }
+    int index = room->y * WORLD_WIDTH + room->x;
+
+    // A save landing during the read may clear cells the file copy is missing, read again then.
+    // Cells still dirty are overlaid, so a half applied save is fine.
+    pthread_mutex_lock(&save->mutex);
+    while(true)
+    {
+        unsigned int saveCount = save->saveCount;
+        pthread_mutex_unlock(&save->mutex);
+        RoomLoad(room);
+        pthread_mutex_lock(&save->mutex);
+        if(save->saveCount == saveCount) break;
+    }
+    if(save->dirtyRooms[index])
+    {
+        for(int i = 0; i < ROOM_CELLS_LENGTH; i++)
+        {
+            if(save->dirtyCells[index * ROOM_CELLS_LENGTH + i]) room->cells[i] = save->values[index * ROOM_CELLS_LENGTH + i];
+        }
+    }
+    pthread_mutex_unlock(&save->mutex);
+}
+
+void WorldSaveRequest(WorldSave *save)
+{
+    pthread_mutex_lock(&save->mutex);
+    save->saveRequested = true;
+    save->lastSaveTime = GetTime();
+    if(!save->threaded)
+    {
+        save->saveRequested = false;
+        WorldSaveWrite(save);
+    }
+    pthread_cond_signal(&save->cond);
+    pthread_mutex_unlock(&save->mutex);
+}
+
+// Uses GetTime, GetFrameTime is not updated under custom frame control
+void WorldSaveUpdate(WorldSave *save)
+{
+    if(GetTime() - save->lastSaveTime < AUTOSAVE_INTERVAL) return;
+    WorldSaveRequest(save);
+}
+
+const WorldSaveReport WorldSaveGetReport(WorldSave *save)
+{
+    pthread_mutex_lock(&save->mutex);
+    WorldSaveReport report = save->report;
+    pthread_mutex_unlock(&save->mutex);
+    return report;
+}
+
+static void *WorldSaveWorker(void *arg)
+{
+    WorldSave *save = arg;
+
+    pthread_mutex_lock(&save->mutex);
+    while(true)
+    {
+        if(!save->saveRequested)
+        {
+            if(!save->running) break;
+            pthread_cond_wait(&save->cond, &save->mutex);
+            continue;
+        }
+        save->saveRequested = false;
+        WorldSaveWrite(save);
+    }
+    pthread_mutex_unlock(&save->mutex);
+
+    return NULL;
+}
+
+// Must be called with the mutex locked, it is released during file IO
+static void WorldSaveWrite(WorldSave *save)
+{
+    if(save->roomCount == 0) return;
+
+    int length = 0;
+    int *journal = WorldSaveBuildJournal(save, &length);
+    pthread_mutex_unlock(&save->mutex);
+
+    int worldBytes = 0;
+    bool saved = JournalWrite(journal, length) && JournalApply(journal, &worldBytes);
+    if(saved) remove(FILENAME_WORLD_JOURNAL);
+
+    pthread_mutex_lock(&save->mutex);
+    save->report.failed = !saved;
+    if(saved)
+    {
+        WorldSaveClearWritten(save, journal);
+        save->saveCount++;
+        save->report.cells = journal[2];
+        save->report.worldBytes = worldBytes;
+        save->report.journalBytes = length * sizeof(int);
+        TraceLog(LOG_INFO, "WORLDSAVE: Saved %i cells, %i bytes to world, %i bytes to journal", save->report.cells, save->report.worldBytes, save->report.journalBytes);
+    }
+    MemFree(journal);
+}
+
+// Snapshot every run of dirty cells, must be called with the mutex locked
+static int *WorldSaveBuildJournal(WorldSave *save, int *length)
+{
+    int runs = 0;
+    int cells = 0;
+    for(int r = 0; r < save->roomCount; r++)
+    {
+        const unsigned char *dirty = save->dirtyCells + save->roomList[r] * ROOM_CELLS_LENGTH;
+        for(int i = 0; i < ROOM_CELLS_LENGTH; i++)
+        {
+            if(!dirty[i]) continue;
+            if(i == 0 || !dirty[i - 1]) runs++;
+            cells++;
+        }
+    }
+
+    *length = 3 + runs * 2 + cells + 1;
+    int *journal = MemAlloc(*length * sizeof(int));
+    journal[0] = JOURNAL_MAGIC;
+    journal[1] = runs;
+    journal[2] = cells;
+
+    int *ptr = journal + 3;
+    for(int r = 0; r < save->roomCount; r++)
+    {
+        int first = save->roomList[r] * ROOM_CELLS_LENGTH;
+        for(int i = 0; i < ROOM_CELLS_LENGTH; i++)
+        {
+            if(!save->dirtyCells[first + i]) continue;
+            int *run = ptr;
+            run[0] = (first + i) * sizeof(int);
+            run[1] = 0;
+            ptr += 2;
+            while(i < ROOM_CELLS_LENGTH && save->dirtyCells[first + i])
+            {
+                *ptr++ = save->values[first + i];
+                run[1]++;
+                i++;
+            }
+        }
+    }
+    *ptr = HashBytes(2166136261u, journal, (*length - 1) * sizeof(int));
+
+    return journal;
+}
+
+// Cells edited again while the save was running stay dirty
+static void WorldSaveClearWritten(WorldSave *save, const int *journal)
+{
+    const int *ptr = journal + 3;
+    for(int run = 0; run < journal[1]; run++)
+    {
+        int first = ptr[0] / sizeof(int);
+        int count = ptr[1];
+        ptr += 2;
+        for(int i = 0; i < count; i++)
+        {
+            if(save->values[first + i] == ptr[i]) save->dirtyCells[first + i] = false;
+        }
+        ptr += count;
+    }
+
+    int kept = 0;
+    for(int r = 0; r < save->roomCount; r++)
+    {
+        int room = save->roomList[r];
+        bool dirty = false;
+        for(int i = 0; i < ROOM_CELLS_LENGTH && !dirty; i++) dirty = save->dirtyCells[room * ROOM_CELLS_LENGTH + i];
+        if(dirty) save->roomList[kept++] = room;
+        else save->dirtyRooms[room] = false;
+    }
+    save->roomCount = kept;
+}
+
+// Marks the journal cells as pending edits, only called before the worker starts
+static void WorldSaveImportJournal(WorldSave *save, const int *journal)
+{
+    const int *ptr = journal + 3;
+    for(int run = 0; run < journal[1]; run++)
+    {
+        int first = ptr[0] / sizeof(int);
+        int count = ptr[1];
+        ptr += 2;
+        for(int i = 0; i < count; i++)
+        {
+            int index = (first + i) / (ROOM_CELLS_LENGTH);
+            save->values[first + i] = ptr[i];
+            save->dirtyCells[first + i] = true;
+            if(!save->dirtyRooms[index])
+            {
+                save->dirtyRooms[index] = true;
+                save->roomList[save->roomCount++] = index;
+            }
+        }
+        ptr += count;
+    }
+}
+
+static bool JournalCheck(const int *journal, int length)
+{
+    if(length < 4 || journal[0] != JOURNAL_MAGIC) return false;
+
+    int position = 3;
+    int cells = 0;
+    for(int run = 0; run < journal[1]; run++)
+    {
+        if(position + 2 > length - 1) return false;
+        int offset = journal[position];
+        int count = journal[position + 1];
+        if(count <= 0 || count > ROOM_CELLS_LENGTH * WORLD_ROOMS_LENGTH) return false;
+        if(offset < 0 || offset + count * (int)sizeof(int) > WORLD_DATA_SIZE) return false;
+        position += 2 + count;
+        cells += count;
+    }
+    if(position != length - 1 || cells != journal[2]) return false;
+
+    return (unsigned int)journal[length - 1] == HashBytes(2166136261u, journal, (length - 1) * sizeof(int));
+}
+
+// Written aside then renamed, a journal kept from a failed replay is never truncated
+static bool JournalWrite(const int *journal, int length)
+{
+    FILE *file = fopen(FILENAME_WORLD_JOURNAL_TEMP, "wb");
+    if(!file) return false;
+    bool written = fwrite(journal, sizeof(int), length, file) == (size_t)length;
+    written = written && fflush(file) == 0 && FileSync(file) == 0;
+    fclose(file);
+    if(written) written = FileReplace(FILENAME_WORLD_JOURNAL_TEMP, FILENAME_WORLD_JOURNAL) == 0;
+    if(!written) remove(FILENAME_WORLD_JOURNAL_TEMP);
+    return written;
+}
+
+// Positioned writes of each run, the world file is never rewritten whole
+// worldBytes counts the whole file when it had to be created first
+static bool JournalApply(const int *journal, int *worldBytes)
+{
+    *worldBytes = journal[2] * sizeof(int);
+    if(!FileExists(FILENAME_WORLD))
+    {
+        int *walls = MemAlloc(WORLD_DATA_SIZE);
+        for(int i = 0; i < ROOM_CELLS_LENGTH * WORLD_ROOMS_LENGTH; i++) walls[i] = TILE_WALL;
+        bool created = SaveFileData(FILENAME_WORLD, walls, WORLD_DATA_SIZE);
+        MemFree(walls);
+        if(!created) return false;
+        *worldBytes += WORLD_DATA_SIZE;
+    }
+    else if(GetFileLength(FILENAME_WORLD) != WORLD_DATA_SIZE)
+    {
+        TraceLog(LOG_WARNING, "WORLDSAVE: %s has an unexpected size, edits kept in memory", FILENAME_WORLD);
+        return false;
+    }
+
+    FILE *file = fopen(FILENAME_WORLD, "r+b");
+    if(!file) return false;
+
+    bool written = true;
+    const int *ptr = journal + 3;
+    for(int run = 0; run < journal[1] && written; run++)
+    {
+        int count = ptr[1];
+        written = fseek(file, ptr[0], SEEK_SET) == 0 && fwrite(ptr + 2, sizeof(int), count, file) == (size_t)count;
+        ptr += 2 + count;
+    }
+    written = written && fflush(file) == 0 && FileSync(file) == 0;
+    fclose(file);
+    return written;
+}
@@ -0,0 +1,45 @@
+#ifndef WORLDSAVE_H
+#define WORLDSAVE_H
+
+#include <pthread.h>
+#include "raylib.h"
+#include "game_params.h"
+#include "grid.h"
+
+typedef struct WorldSaveReport
+{
+    int cells;                  // Cells written by the last save
+    int worldBytes;             // Bytes written to the world file
+    int journalBytes;           // Bytes written to the journal
+    bool failed;
+} WorldSaveReport;
+
+// Editor edits waiting to be written to the world file. Saves run on a worker
+// thread, go through a journal first and only write the edited cells.
+typedef struct WorldSave
+{
+    int *values;                // Pending cell values, ROOM_CELLS_LENGTH per room
+    unsigned char *dirtyCells;
+    unsigned char *dirtyRooms;  // Room is in roomList
+    int *roomList;
+    int roomCount;
+    double lastSaveTime;        // GetTime of the last request
+    bool saveRequested;
+    unsigned int saveCount;     // Bumped once a save is in the world file and its cells are cleared
+    bool running;
+    bool threaded;              // False when the worker could not start, saves then run on the main thread
+    WorldSaveReport report;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} WorldSave;
+
+void WorldSaveInit(WorldSave *save);
+void WorldSaveUnload(WorldSave *save);
+void WorldSaveMarkCell(WorldSave *save, const Grid *room, int x, int y);
+void WorldSaveLoadRoom(WorldSave *save, Grid *room);
+void WorldSaveRequest(WorldSave *save);
+void WorldSaveUpdate(WorldSave *save);
+const WorldSaveReport WorldSaveGetReport(WorldSave *save);
+
+#endif
\ No newline at end of file